@@ -1,13 +1,68 @@
 #include "brightness_controller.h"
 #include "ch32fun.h"
 #include "config.h"
+#include "cycle_count.h"
 
+#ifdef LAMP_STATIC_CONFIG
+#define CONTROLLER_MIN_BRIGHTNESS_DIM_ON(controller) min_brightness_dim_on
+#define CONTROLLER_MIN_BRIGHTNESS_MIN_PERIOD_MS(controller)                    \
+  min_brightness_min_period_ms
+#define CONTROLLER_DIM_ON_FADE_MS(controller) brightness_dim_on_fade_ms
+#define CONTROLLER_TURN_ON_FADE_MS(controller) brightness_turn_on_fade_ms
+#define CONTROLLER_TURN_OFF_FADE_MS(controller) brightness_turn_off_fade_ms
+#define CONTROLLER_TURN_OFF_TAIL_FADE_MS(controller)                           \
+  brightness_turn_off_tail_fade_ms
+#define CONTROLLER_EASING(controller) brightness_fade_easing
+#define CONTROLLER_LED_OFF_VALUE(controller)                                   \
+  pwm_period(pwm_mode, led_off_value)
+#define CONTROLLER_STEP_VALUE(controller, brightness)                          \
+  pwm_scale(pwm_mode, brightness_steps[brightness])
+#else
+#define CONTROLLER_MIN_BRIGHTNESS_DIM_ON(controller)                           \
+  ((controller)->min_brightness_dim_on)
+#define CONTROLLER_MIN_BRIGHTNESS_MIN_PERIOD_MS(controller)                    \
+  ((controller)->min_brightness_min_period_ms)
+#define CONTROLLER_DIM_ON_FADE_MS(controller)                                  \
+  ((controller)->brightness_dim_on_fade_ms)
+#define CONTROLLER_TURN_ON_FADE_MS(controller)                                 \
+  ((controller)->brightness_turn_on_fade_ms)
+#define CONTROLLER_TURN_OFF_FADE_MS(controller)                                \
+  ((controller)->brightness_turn_off_fade_ms)
+#define CONTROLLER_TURN_OFF_TAIL_FADE_MS(controller)                           \
+  ((controller)->brightness_turn_off_tail_fade_ms)
+#define CONTROLLER_EASING(controller) ((controller)->easing)
+#define CONTROLLER_LED_OFF_VALUE(controller) ((controller)->led_off_value)
+#define CONTROLLER_STEP_VALUE(controller, brightness)                          \
+  pwm_scale((controller)->pwm_mode,                                            \
+            (controller)->brightness_step_mapping[brightness])
+#endif
+
+#ifdef LAMP_CYCLE_COUNT
+volatile CycleCount brightness_write_cycles = CYCLE_COUNT_INIT;
+#endif
+
+// Fade progress is a Q15 fixed point fraction, 0 = start, 1 << 15 = done.
+#define FADE_PROGRESS_ONE (1UL << 15)
+
+#ifdef LAMP_STATIC_CONFIG
+BrightnessController brightnessController(void) {
+  BrightnessController controller = {
+      .last_on_time = 0,
+      .last_brightness = 255,
+      .is_on = false,
+  };
+
+  return controller;
+}
+#else
 BrightnessController brightnessController(
     volatile uint32_t **control_field, int count,
-    const uint16_t *brightness_step_mapping, uint16_t min_brightness_dim_on,
-    uint32_t min_brightness_min_period_ms,
-    uint32_t brightness_rampdown_delay_ms, uint32_t brightness_rampup_delay_ms,
-    uint32_t turn_off_brightness_rampdown_delay_ms, uint16_t led_off_value) {
+    const uint16_t *brightness_step_mapping, PwmMode pwm_mode,
+    uint16_t min_brightness_dim_on, uint32_t min_brightness_min_period_ms,
+    uint32_t brightness_dim_on_fade_ms, uint32_t brightness_turn_on_fade_ms,
+    uint32_t brightness_turn_off_fade_ms,
+    uint32_t brightness_turn_off_tail_fade_ms,
+    BrightnessEasing easing, uint16_t led_off_value) {
   BrightnessController controller = {
       .control_field = control_field,
       .last_on_time = 0,
@@ -15,92 +70,111 @@ BrightnessController brightnessController(
       .is_on = false,
       .count = count,
       .brightness_step_mapping = brightness_step_mapping,
+      .pwm_mode = pwm_mode,
       .min_brightness_dim_on = min_brightness_dim_on,
       .min_brightness_min_period_ms = min_brightness_min_period_ms,
-      .brightness_rampdown_delay_ms = brightness_rampdown_delay_ms,
-      .brightness_rampup_delay_ms = brightness_rampup_delay_ms,
-      .turn_off_brightness_rampdown_delay_ms =
-          turn_off_brightness_rampdown_delay_ms,
+      .brightness_dim_on_fade_ms = brightness_dim_on_fade_ms,
+      .brightness_turn_on_fade_ms = brightness_turn_on_fade_ms,
+      .brightness_turn_off_fade_ms = brightness_turn_off_fade_ms,
+      .brightness_turn_off_tail_fade_ms =
+          brightness_turn_off_tail_fade_ms,
+      .easing = easing,
       .led_off_value = led_off_value,
   };
 
   return controller;
 }
+#endif
 
-void brightnessController_rampUpDown(BrightnessController *controller,
-                                     uint8_t start_brightness,
-                                     uint8_t end_brightness, uint32_t speed) {
-  if (start_brightness == end_brightness) {
-    for (int i = 0; i < controller->count; i++) {
-      *controller->control_field[i] =
-          controller->brightness_step_mapping[start_brightness];
-    }
+static inline void brightnessController_writeValue(
+    BrightnessController *controller, uint16_t value) {
+  CYCLE_COUNT_START();
+#ifdef LAMP_STATIC_CONFIG
+  (void)controller;
+#define LED_CONTROL_FIELD_STORE(field) field = value;
+  LED_CONTROL_FIELDS(LED_CONTROL_FIELD_STORE)
+#undef LED_CONTROL_FIELD_STORE
+#else
+  for (int i = 0; i < controller->count; i++) {
+    *controller->control_field[i] = value;
+  }
+#endif
+  CYCLE_COUNT_STOP(brightness_write_cycles);
+}
 
-  } else if (start_brightness < end_brightness) {
-    uint32_t brightness = start_brightness;
-    uint32_t last_duration = SysTick->CNT;
-    for (int i = 0; i < controller->count; i++) {
-      *controller->control_field[i] =
-          controller->brightness_step_mapping[brightness];
-    }
-    while (brightness < end_brightness) {
-      uint32_t systick = SysTick->CNT;
-      if (((systick - last_duration) / DELAY_MS_TIME) >=
-          (speed == 0 ? controller->brightness_rampup_delay_ms : speed)) {
-        last_duration = systick;
-        brightness++;
-        brightness &= 255;
-        for (int i = 0; i < controller->count; i++) {
-          *controller->control_field[i] =
-              controller->brightness_step_mapping[brightness];
-        }
-      }
-      Delay_Ms(1);
-    }
+static inline void brightnessController_write(BrightnessController *controller,
+                                              uint32_t brightness) {
+  brightnessController_writeValue(
+      controller, CONTROLLER_STEP_VALUE(controller, brightness));
+}
 
-  } else {
-    uint32_t brightness = start_brightness;
-    uint32_t last_duration = SysTick->CNT;
-    for (int i = 0; i < controller->count; i++) {
-      *controller->control_field[i] =
-          controller->brightness_step_mapping[brightness];
-    }
-    while (brightness > end_brightness) {
-      uint32_t systick = SysTick->CNT;
-      if (((systick - last_duration) / DELAY_MS_TIME) >=
-          (speed == 0 ? controller->brightness_rampdown_delay_ms : speed)) {
-        last_duration = systick;
-        brightness--;
-        brightness &= 255;
-        for (int i = 0; i < controller->count; i++) {
-          *controller->control_field[i] =
-              controller->brightness_step_mapping[brightness];
-        }
-      }
-      Delay_Ms(1);
-    }
+// Eased progress of a fade that started at start_systick, computed from the
+// elapsed time alone so a fade always ends on time no matter how irregularly
+// it is polled.
+static uint32_t brightnessController_fadeProgress(uint32_t start_systick,
+                                                  uint32_t duration_ms,
+                                                  BrightnessEasing easing) {
+  // Elapsed time in 1/16 ms, clamped to the duration. This keeps the
+  // division below within 32 bit for durations up to ~131 s.
+  uint32_t elapsed = (SysTick->CNT - start_systick) / (DELAY_MS_TIME / 16);
+  if (elapsed >= duration_ms * 16) {
+    return FADE_PROGRESS_ONE;
+  }
+
+  uint32_t p = (elapsed * (FADE_PROGRESS_ONE / 16)) / duration_ms;
+
+  switch (easing) {
+  case BrightnessEasingEaseIn:
+    return (p * p) >> 15;
+  case BrightnessEasingEaseOut:
+    return (p * (2 * FADE_PROGRESS_ONE - p)) >> 15;
+  case BrightnessEasingEaseInOut:
+    // Smoothstep, 3p^2 - 2p^3
+    return (((p * p) >> 15) * (3 * FADE_PROGRESS_ONE - 2 * p)) >> 15;
+  case BrightnessEasingLinear:
+  default:
+    return p;
   }
 }
 
+static inline int32_t brightnessController_lerp(int32_t from, int32_t to,
+                                                uint32_t progress) {
+  return from + ((to - from) * (int32_t)progress) / (int32_t)FADE_PROGRESS_ONE;
+}
+
+void brightnessController_fade(BrightnessController *controller,
+                               uint8_t start_brightness, uint8_t end_brightness,
+                               uint32_t duration_ms, BrightnessEasing easing) {
+  uint32_t start_systick = SysTick->CNT;
+  uint32_t progress;
+  int32_t last_brightness = -1;
+
+  do {
+    progress =
+        brightnessController_fadeProgress(start_systick, duration_ms, easing);
+    int32_t brightness =
+        brightnessController_lerp(start_brightness, end_brightness, progress);
+    if (brightness != last_brightness) {
+      last_brightness = brightness;
+      brightnessController_write(controller, brightness);
+    }
+  } while (progress < FADE_PROGRESS_ONE);
+}
+
 void brightnessController_set(BrightnessController *controller,
                               uint8_t target_brightness) {
-  if (target_brightness < controller->min_brightness_dim_on &&
+  if (target_brightness < CONTROLLER_MIN_BRIGHTNESS_DIM_ON(controller) &&
       (SysTick->CNT - controller->last_on_time) / DELAY_MS_TIME >
-          controller->min_brightness_min_period_ms &&
+          CONTROLLER_MIN_BRIGHTNESS_MIN_PERIOD_MS(controller) &&
       !controller->is_on) {
-    uint32_t brightness = controller->min_brightness_dim_on;
-    for (int i = 0; i < controller->count; i++) {
-      *controller->control_field[i] =
-          controller->brightness_step_mapping[brightness];
-    }
+    uint32_t brightness = CONTROLLER_MIN_BRIGHTNESS_DIM_ON(controller);
+    brightnessController_write(controller, brightness);
     Delay_Ms(50);
-    brightnessController_rampUpDown(controller, brightness, target_brightness,
-                                    0);
+    brightnessController_fade(controller, brightness, target_brightness,
+                              CONTROLLER_DIM_ON_FADE_MS(controller),
+                              CONTROLLER_EASING(controller));
   } else {
-    for (int i = 0; i < controller->count; i++) {
-      *controller->control_field[i] =
-          controller->brightness_step_mapping[target_brightness];
-    }
+    brightnessController_write(controller, target_brightness);
   }
   controller->last_brightness = target_brightness;
   controller->is_on = true;
@@ -108,24 +182,37 @@ void brightnessController_set(BrightnessController *controller,
 }
 
 void brightnessController_on(BrightnessController *controller) {
-  brightnessController_rampUpDown(controller, controller->min_brightness_dim_on,
-                                  controller->last_brightness, 2);
+  brightnessController_fade(
+      controller, CONTROLLER_MIN_BRIGHTNESS_DIM_ON(controller),
+      controller->last_brightness, CONTROLLER_TURN_ON_FADE_MS(controller),
+      CONTROLLER_EASING(controller));
   controller->is_on = true;
   controller->last_on_time = SysTick->CNT;
 }
 
 void brightnessController_off(BrightnessController *controller) {
-  brightnessController_rampUpDown(
-      controller, controller->last_brightness, 10,
-      controller->turn_off_brightness_rampdown_delay_ms);
-
-  while (led_off_value - *controller->control_field[0] > 10) {
-    for (int i = 0; i < controller->count; i++) {
-      *controller->control_field[i] +=
-          (led_off_value - *controller->control_field[i]) / 2;
+  brightnessController_fade(controller, controller->last_brightness, 0,
+                            CONTROLLER_TURN_OFF_FADE_MS(controller),
+                            CONTROLLER_EASING(controller));
+
+  // The dimmest table entry is still slightly on, so finish with a short
+  // linear fade of the raw compare value to led_off_value.
+  uint32_t start_systick = SysTick->CNT;
+  uint32_t progress;
+  int32_t last_value = -1;
+  do {
+    progress = brightnessController_fadeProgress(
+        start_systick, CONTROLLER_TURN_OFF_TAIL_FADE_MS(controller),
+        BrightnessEasingLinear);
+    int32_t value =
+        brightnessController_lerp(CONTROLLER_STEP_VALUE(controller, 0),
+                                  CONTROLLER_LED_OFF_VALUE(controller),
+                                  progress);
+    if (value != last_value) {
+      last_value = value;
+      brightnessController_writeValue(controller, value);
     }
-    Delay_Ms(controller->turn_off_brightness_rampdown_delay_ms);
-  }
+  } while (progress < FADE_PROGRESS_ONE);
 
   controller->is_on = false;
   controller->last_on_time = SysTick->CNT;
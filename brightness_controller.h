@@ -1,9 +1,32 @@
 #ifndef _LAMP_BRIGHTNESS_CONTROLLER_H
 #define _LAMP_BRIGHTNESS_CONTROLLER_H
 
+#include "pwm.h"
+
 #include <stdbool.h>
 #include <stdint.h>
 
+// Shape of a fade over its duration. The brightness table is already
+// perceptual, so linear steps through it look linear to the eye.
+typedef enum BrightnessEasing {
+  BrightnessEasingLinear = 0,
+  // Starts slow, ends fast
+  BrightnessEasingEaseIn = 1,
+  // Starts fast, ends slow
+  BrightnessEasingEaseOut = 2,
+  // Slow at both ends (smoothstep)
+  BrightnessEasingEaseInOut = 3
+} BrightnessEasing;
+
+#ifdef LAMP_STATIC_CONFIG
+typedef struct BrightnessController {
+  uint32_t last_on_time;
+  uint32_t last_brightness;
+  bool is_on;
+} BrightnessController;
+
+BrightnessController brightnessController(void);
+#else
 typedef struct BrightnessController {
   uint32_t last_on_time;
   uint32_t last_brightness;
@@ -11,27 +34,37 @@ typedef struct BrightnessController {
   volatile uint32_t **control_field;
   int count;
   const uint16_t *brightness_step_mapping;
+  // Mode the table values are scaled to, see pwm_scale
+  PwmMode pwm_mode;
   uint16_t min_brightness_dim_on;
   uint32_t min_brightness_min_period_ms;
-  uint32_t brightness_rampdown_delay_ms;
-  uint32_t brightness_rampup_delay_ms;
-  uint32_t turn_off_brightness_rampdown_delay_ms;
+  uint32_t brightness_dim_on_fade_ms;
+  uint32_t brightness_turn_on_fade_ms;
+  uint32_t brightness_turn_off_fade_ms;
+  uint32_t brightness_turn_off_tail_fade_ms;
+  BrightnessEasing easing;
   uint16_t led_off_value;
 
 } BrightnessController;
 
 BrightnessController brightnessController(
     volatile uint32_t **control_field, int count,
-    const uint16_t *brightness_step_mapping, uint16_t min_brightness_dim_on,
-    uint32_t min_brightness_min_period_ms,
-    uint32_t brightness_rampdown_delay_ms, uint32_t brightness_rampup_delay_ms,
-    uint32_t turn_off_brightness_rampdown_delay_ms, uint16_t led_off_value
+    const uint16_t *brightness_step_mapping, PwmMode pwm_mode,
+    uint16_t min_brightness_dim_on, uint32_t min_brightness_min_period_ms,
+    uint32_t brightness_dim_on_fade_ms, uint32_t brightness_turn_on_fade_ms,
+    uint32_t brightness_turn_off_fade_ms,
+    uint32_t brightness_turn_off_tail_fade_ms,
+    BrightnessEasing easing, uint16_t led_off_value
 
 );
+#endif
 
-void brightnessController_rampUpDown(BrightnessController *controller,
-                                     uint8_t start_brightness,
-                                     uint8_t end_brightness, uint32_t speed);
+// Fades from start_brightness to end_brightness in duration_ms (at most
+// ~131 s). The brightness is derived from the elapsed time on every iteration,
+// so the fade finishes on time without per-step delays.
+void brightnessController_fade(BrightnessController *controller,
+                               uint8_t start_brightness, uint8_t end_brightness,
+                               uint32_t duration_ms, BrightnessEasing easing);
 
 void brightnessController_set(BrightnessController *controller,
                               uint8_t target_brightness);
@@ -1,6 +1,9 @@
 #ifndef __TEST_FIRMWARE_CONFIG_H
 #define __TEST_FIRMWARE_CONFIG_H
 
+#include "brightness_controller.h"
+#include "pwm.h"
+
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -186,13 +189,24 @@ static const uint16_t min_brightness_dim_on = 175;
 // The minimum period in milliseconds for the led to be off to be considered
 // "fully off" (startup procedure is not done during this duration)
 static const uint32_t min_brightness_min_period_ms = 100;
-// The delay between steps of automatic rampdown,
-// range 1..uint32_t::MAX_VALUE. Smaller = rampdown faster, larger = rampdown
-// slower
-static const uint32_t brightness_rampdown_delay_ms = 12;
-// The delay between steps of automatic rampup, range 1..uint32_t::MAX_VALUE.
-// Smaller = rampup faster, larger = rampup slower
-static const uint32_t brightness_rampup_delay_ms = 7;
+// Duration of the fade from min_brightness_dim_on to the requested brightness
+// when the lamp is turned on from a fully off state, in milliseconds. The old
+// 12 ms per step took 0..2.1 s depending on the target, this matches it for a
+// target in the middle of that range. The fade blocks the main loop, so touch
+// input is not read for this long, even if the target is one step away.
+static const uint32_t brightness_dim_on_fade_ms = 1050;
+// Duration of the fade up to the last brightness when the lamp is turned on,
+// in milliseconds. Independent of the brightness the lamp is turned on to.
+static const uint32_t brightness_turn_on_fade_ms = 160;
+// Duration of the fade down to the dimmest table entry when the lamp is
+// turned off, in milliseconds.
+static const uint32_t brightness_turn_off_fade_ms = 700;
+// Duration of the final fade from the dimmest table entry to fully off, in
+// milliseconds.
+static const uint32_t brightness_turn_off_tail_fade_ms = 20;
+// Shape of the above fades, see BrightnessEasing in brightness_controller.h.
+static const BrightnessEasing brightness_fade_easing =
+    BrightnessEasingEaseInOut;
 // The delay between steps of rampdown when user is pressing the touch
 // button, range 1..uint32_t::MAX_VALUE. Smaller = rampdown faster, larger =
 // rampdown slower
@@ -201,7 +215,6 @@ static const uint32_t brightness_touch_rampup_delay_ms = 11;
 // range 1..uint32_t::MAX_VALUE. Smaller = rampup faster, larger = rampup
 // slower
 static const uint32_t brightness_touch_rampdown_delay_ms = 11;
-static const uint32_t turn_off_brightness_rampdown_delay_ms = 3;
 // Duration after which the press is considered a long press and the
 // brightness change starts.
 static const uint32_t single_touch_duration_ms = 250;
@@ -228,10 +241,49 @@ static const uint16_t timer_prescale = 0;
 // Timer reset point / max led value (off) for the brightness table. Will
 // affect PWM frequency. Highly suggested to leave as-is.
 static const uint16_t led_off_value = 16383;
+// PWM frequency mode, see PwmMode in pwm.h. Higher modes divide the timer
+// period (and the brightness table values) by 2 per step, which moves the PWM
+// frequency away from camera banding and audible coil whine at the cost of
+// brightness resolution. With the current table the number of distinct
+// brightness steps (out of 256) is 255 at 2.9 kHz, 254 at 5.9 kHz, 251 at
+// 11.7 kHz and 244 at 23.4 kHz, the dim end of the table collapsing first.
+// Run `make pwm_report` to re-evaluate after changing the table.
+static const PwmMode pwm_mode = PwmMode2k9;
+// Phase offset of the TIM2 led string relative to the TIM1 one, in 1/256 of
+// a PWM period. 128 switches the strings on half a period apart, which halves
+// the supply current swing and doubles its frequency, and at 50% duty the
+// current is constant. 0 restores the old behaviour of both strings rising
+// together. `make pwm_report` prints the swing for every mode and offset.
+static const uint8_t pwm_phase_offset = 128;
+// Compare registers of the led channels, as a list of X(register) entries.
+// Both builds take their channels from here, the LAMP_STATIC_CONFIG one
+// stores brightness values to them directly.
+#define LED_CONTROL_FIELDS(X) X(TIM2->CH3CVR) X(TIM1->CH2CVR)
+// GPIO port, pin and ADC channel of the touch pad for the ADC backend. PA2 is
+// ADC channel 0. The capture backend (TOUCH_BACKEND=capture) always uses PD4,
+// the TIM2 channel 1 input.
+#define TOUCH_SENSE_IO GPIOA
+static const int touch_sense_portpin = 2;
+static const int touch_sense_adcno = 0;
 // Iterations of oversampling when meassuring touch inputs. Needs to be
 // determined through experimentation. Higher = better accuracy, lower =
-// faster touch response.
+// faster touch response. For the capture backend this is the number of charge
+// cycles per block, see touch_capture_reading_ms.
+#ifdef LAMP_TOUCH_CAPTURE
+static const uint16_t touch_oversampling_iterations = 32;
+#else
 static const uint16_t touch_oversampling_iterations = 3000;
+#endif
+// Duration of one capture backend reading, in milliseconds. A reading averages
+// as many blocks as fit into it. This paces readings to the ~13 ms of an ADC
+// backend reading, so the hysteresis, calibration and re-calibration counts
+// below mean the same time on both backends, and every reading spans most of
+// a mains period instead of sampling the hum.
+static const uint32_t touch_capture_reading_ms = 13;
+// Charge time increase per capture cycle, in timer ticks, above which the
+// capture backend considers the pad touched. The ADC backend triggers at 0.5%
+// above the idle value instead.
+static const uint32_t touch_capture_trigger_ticks = 2;
 // Touch hysteresis: how many touch messurements need to be on for the sensor
 // to be considered pressed, how many need to be off for the sensor to be
 // considered depressed?
@@ -250,6 +302,7 @@ static const uint8_t touch_hysteresis_window = 3;
 // taken as touch inputs, so a good idle value is critical.
 static const uint16_t touch_turn_on_calibration_count = 25;
 // How many iterations to wait after the touch sensor is depressed to start
-// re-calibrating the idle value automatically.
+// re-calibrating the idle value automatically. Counted in readings of ~13 ms,
+// so 1000 is ~13 s.
 static const uint16_t touch_recalibrate_settle_iterations = 1000;
 #endif
@@ -0,0 +1,44 @@
+#ifndef _LAMP_CYCLE_COUNT_H
+#define _LAMP_CYCLE_COUNT_H
+
+#include "ch32fun.h"
+
+#include <stdint.h>
+
+// Per-call cycle counters for comparing build configurations, enabled with
+// `make CYCLE_COUNT=1`. funconfig.h then clocks SysTick from HCLK, so a tick
+// is a core cycle. The counts include the two SysTick reads around the call.
+// Read the counters with a debugger.
+typedef struct CycleCount {
+  uint32_t last;
+  uint32_t min;
+  uint32_t max;
+  uint32_t calls;
+} CycleCount;
+
+#ifdef LAMP_CYCLE_COUNT
+extern volatile CycleCount brightness_write_cycles;
+extern volatile CycleCount read_touch_sensor_cycles;
+
+static inline void cycleCount_record(volatile CycleCount *count,
+                                     uint32_t cycles) {
+  count->last = cycles;
+  if (cycles < count->min) {
+    count->min = cycles;
+  }
+  if (cycles > count->max) {
+    count->max = cycles;
+  }
+  count->calls++;
+}
+
+#define CYCLE_COUNT_INIT {.last = 0, .min = UINT32_MAX, .max = 0, .calls = 0}
+#define CYCLE_COUNT_START() uint32_t cycle_count_start = SysTick->CNT
+#define CYCLE_COUNT_STOP(count)                                                \
+  cycleCount_record(&(count), SysTick->CNT - cycle_count_start)
+#else
+#define CYCLE_COUNT_START()
+#define CYCLE_COUNT_STOP(count)
+#endif
+
+#endif
@@ -3,4 +3,10 @@
 
 #define CH32V003 1
 
+#ifdef LAMP_CYCLE_COUNT
+// Clock SysTick from HCLK so the counters in cycle_count.h count core cycles.
+// All delays and timeouts are derived from DELAY_MS_TIME and stay the same.
+#define FUNCONF_SYSTICK_USE_HCLK 1
+#endif
+
 #endif
@@ -0,0 +1,46 @@
+#include "pwm.h"
+#include "ch32fun.h"
+
+void pwm_init(const PwmConfig *config) {
+  // Reset timer 1
+  RCC->APB2PRSTR |= RCC_APB2Periph_TIM1;
+  RCC->APB2PRSTR &= ~RCC_APB2Periph_TIM1;
+
+  // Reset timer 2
+  RCC->APB1PRSTR |= RCC_APB1Periph_TIM2;
+  RCC->APB1PRSTR &= ~RCC_APB1Periph_TIM2;
+
+  TIM1->PSC = config->prescale;
+  TIM2->PSC = config->prescale;
+
+  TIM1->ATRLR = config->period;
+  TIM2->ATRLR = config->period;
+
+  TIM1->SWEVGR |= TIM_UG;
+  TIM2->SWEVGR |= TIM_UG;
+
+  // Enable Timer1 Channel2 Output
+  TIM1->CCER |= TIM_CC2E | TIM_CC2P;
+  TIM1->CCER |= TIM_CC2E;
+  TIM1->CHCTLR1 |= TIM_OC2M_2 | TIM_OC2M_1;
+
+  // Enable Timer2 Channel3 Output
+  TIM2->CCER |= TIM_CC3E | TIM_CC3P;
+  // TIM2->CCER |= TIM_CC3E;
+  TIM2->CHCTLR2 |= TIM_OC3M_2 | TIM_OC3M_1;
+
+  TIM1->CH2CVR = config->period;
+  TIM2->CH3CVR = config->period;
+
+  TIM1->BDTR |= TIM_MOE;
+  TIM2->BDTR |= TIM_MOE;
+
+  // Both timers run from the same clock with the same period, so an offset
+  // loaded before they start is kept forever. This staggers the rising edges
+  // of the two led strings instead of switching both on at the same moment.
+  TIM1->CNT = 0;
+  TIM2->CNT = config->phase_offset;
+
+  TIM1->CTLR1 |= TIM_CEN;
+  TIM2->CTLR1 |= TIM_CEN;
+}
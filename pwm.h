@@ -0,0 +1,76 @@
+#ifndef _LAMP_PWM_H
+#define _LAMP_PWM_H
+
+#include <stdint.h>
+
+// PWM frequency modes. Every mode halves the timer period of the previous one,
+// doubling the PWM frequency and costing one bit of brightness resolution.
+// Frequencies are for a 48 MHz HCLK with a timer_prescale of 0 and a
+// led_off_value of 16383.
+typedef enum PwmMode {
+  // 16384 ticks, ~2.9 kHz, 14 bit
+  PwmMode2k9 = 0,
+  // 8192 ticks, ~5.9 kHz, 13 bit
+  PwmMode5k9 = 1,
+  // 4096 ticks, ~11.7 kHz, 12 bit
+  PwmMode11k7 = 2,
+  // 2048 ticks, ~23.4 kHz, 11 bit. Above the audible range.
+  PwmMode23k4 = 3
+} PwmMode;
+
+typedef struct PwmConfig {
+  uint16_t prescale;
+  // Timer reset point (ATRLR), which is also the compare value for "led off"
+  uint16_t period;
+  PwmMode mode;
+  // Counter lead of TIM2 over TIM1 in timer ticks
+  uint16_t phase_offset;
+} PwmConfig;
+
+// Timer period (ATRLR) of a mode, led_off_value halved once per mode step
+static inline uint16_t pwm_period(PwmMode mode, uint16_t led_off_value) {
+  return ((led_off_value + 1UL) >> mode) - 1;
+}
+
+// Implemented in pwm_model.c
+PwmConfig pwmConfig(PwmMode mode, uint16_t prescale, uint16_t led_off_value,
+                    uint8_t phase_offset);
+
+// Resets and configures TIM1 channel 2 and TIM2 channel 3 for PWM output,
+// with both leds off, and starts the timers with the configured phase offset.
+void pwm_init(const PwmConfig *config);
+
+// Brightness table value scaled into the period of a mode. The firmware and
+// the model both scale through here.
+static inline uint16_t pwm_scale(PwmMode mode, uint16_t value) {
+  return value >> mode;
+}
+
+// The following functions only model the configuration. They live in
+// pwm_model.c, which `make pwm_report` also builds for the host to print them
+// for every mode and phase offset.
+
+uint32_t pwm_frequency_hz(const PwmConfig *config, uint32_t core_clock_hz);
+
+uint8_t pwm_resolution_bits(const PwmConfig *config);
+
+// Number of distinct compare values the brightness table collapses to after
+// scaling, i.e. the effective brightness resolution of the mode.
+uint16_t pwm_distinct_steps(const PwmConfig *config, const uint16_t *table,
+                            int count);
+
+// Supply current of both led strings over a period, in units of one string's
+// current. Both strings share the supply, so max_strings - min_strings is the
+// peak to peak current ripple the supply has to filter.
+typedef struct PwmRipple {
+  uint8_t min_strings;
+  uint8_t max_strings;
+  // Harmonic of the PWM frequency the current repeats at, 0 if it is constant.
+  // Equal duties half a period apart repeat every half period, so 2.
+  uint8_t harmonic;
+} PwmRipple;
+
+PwmRipple pwm_ripple(const PwmConfig *config, uint16_t compare_tim1,
+                     uint16_t compare_tim2);
+
+#endif
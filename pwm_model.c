@@ -0,0 +1,103 @@
+#include "pwm.h"
+
+// Hardware independent part of the PWM layer. This file must not depend on
+// ch32fun, it is also built for the host by `make pwm_report`.
+
+PwmConfig pwmConfig(PwmMode mode, uint16_t prescale, uint16_t led_off_value,
+                    uint8_t phase_offset) {
+  uint16_t period = pwm_period(mode, led_off_value);
+
+  PwmConfig config = {
+      .prescale = prescale,
+      .period = period,
+      .mode = mode,
+      .phase_offset = ((period + 1UL) * phase_offset) >> 8,
+  };
+
+  return config;
+}
+
+uint32_t pwm_frequency_hz(const PwmConfig *config, uint32_t core_clock_hz) {
+  return core_clock_hz / ((config->prescale + 1UL) * (config->period + 1UL));
+}
+
+uint8_t pwm_resolution_bits(const PwmConfig *config) {
+  uint8_t bits = 0;
+  for (uint32_t ticks = config->period + 1UL; ticks > 1; ticks >>= 1) {
+    bits++;
+  }
+  return bits;
+}
+
+uint16_t pwm_distinct_steps(const PwmConfig *config, const uint16_t *table,
+                            int count) {
+  if (count == 0) {
+    return 0;
+  }
+
+  uint16_t steps = 1;
+  for (int i = 1; i < count; i++) {
+    if (pwm_scale(config->mode, table[i]) !=
+        pwm_scale(config->mode, table[i - 1])) {
+      steps++;
+    }
+  }
+  return steps;
+}
+
+// Overlap of two linear intervals [start_a, end_a) and [start_b, end_b)
+static uint32_t pwm_interval_overlap(uint32_t start_a, uint32_t end_a,
+                                     uint32_t start_b, uint32_t end_b) {
+  uint32_t start = start_a > start_b ? start_a : start_b;
+  uint32_t end = end_a < end_b ? end_a : end_b;
+  return end > start ? end - start : 0;
+}
+
+// Ticks per period during which both leds conduct at the same time
+static uint32_t pwm_overlap_ticks(const PwmConfig *config,
+                                  uint16_t compare_tim1,
+                                  uint16_t compare_tim2) {
+  uint32_t ticks = config->period + 1UL;
+
+  // A led conducts while its counter is at or above the compare value. Seen
+  // from TIM1's counter, TIM2's on-time starts phase_offset ticks earlier and
+  // may wrap around the end of the period, so split it into two intervals.
+  uint32_t start_tim1 = compare_tim1;
+  uint32_t start_tim2 = (compare_tim2 + ticks - config->phase_offset) % ticks;
+  uint32_t end_tim2 = start_tim2 + (ticks - compare_tim2);
+
+  uint32_t overlap =
+      pwm_interval_overlap(start_tim1, ticks, start_tim2,
+                           end_tim2 < ticks ? end_tim2 : ticks);
+  if (end_tim2 > ticks) {
+    overlap += pwm_interval_overlap(start_tim1, ticks, 0, end_tim2 - ticks);
+  }
+
+  return overlap;
+}
+
+PwmRipple pwm_ripple(const PwmConfig *config, uint16_t compare_tim1,
+                     uint16_t compare_tim2) {
+  uint32_t ticks = config->period + 1UL;
+  uint32_t on_tim1 = ticks - compare_tim1;
+  uint32_t on_tim2 = ticks - compare_tim2;
+  uint32_t both = pwm_overlap_ticks(config, compare_tim1, compare_tim2);
+  // Ticks with neither led on, the rest of the period has exactly one on
+  uint32_t none = ticks - (on_tim1 + on_tim2 - both);
+
+  PwmRipple ripple = {
+      .min_strings = none > 0 ? 0 : (both < ticks ? 1 : 2),
+      .max_strings = both > 0 ? 2 : (none < ticks ? 1 : 0),
+  };
+
+  if (ripple.min_strings == ripple.max_strings) {
+    ripple.harmonic = 0;
+  } else if (compare_tim1 == compare_tim2 &&
+             2UL * config->phase_offset == ticks) {
+    ripple.harmonic = 2;
+  } else {
+    ripple.harmonic = 1;
+  }
+
+  return ripple;
+}
@@ -0,0 +1,62 @@
+// Host tool, built and run by `make pwm_report`. Prints the PWM model from
+// pwm_model.c, including the supply current ripple of both led strings, for
+// every mode and phase offset, using the brightness table, timer_prescale and
+// led_off_value from config.h.
+
+#include "config.h"
+#include "pwm.h"
+
+#include <stdio.h>
+
+// HCLK of the firmware, ch32fun's default FUNCONF_SYSTEM_CORE_CLOCK
+#ifndef PWM_REPORT_CORE_CLOCK_HZ
+#define PWM_REPORT_CORE_CLOCK_HZ 48000000
+#endif
+
+static const uint8_t phase_offsets[] = {0, 64, 128, 192};
+// On-time of both strings, in percent of a period
+static const uint8_t duties[] = {25, 50, 75, 100};
+
+int main(void) {
+  int steps = sizeof(brightness_steps) / sizeof(brightness_steps[0]);
+
+  for (PwmMode mode = PwmMode2k9; mode <= PwmMode23k4; mode++) {
+    PwmConfig config = pwmConfig(mode, timer_prescale, led_off_value, 0);
+    uint32_t ticks = config.period + 1UL;
+
+    printf("mode %d%s: %lu Hz, %u bit, %u of %d brightness steps distinct\n",
+           mode, mode == pwm_mode ? " (configured)" : "",
+           (unsigned long)pwm_frequency_hz(&config, PWM_REPORT_CORE_CLOCK_HZ),
+           pwm_resolution_bits(&config),
+           pwm_distinct_steps(&config, brightness_steps, steps), steps);
+
+    printf("  supply current swing in strings @ its frequency in Hz:\n");
+    printf("  %-13s", "phase offset");
+    for (unsigned d = 0; d < sizeof(duties); d++) {
+      printf(" %11u%%", duties[d]);
+    }
+    printf("\n");
+
+    for (unsigned p = 0; p < sizeof(phase_offsets); p++) {
+      config = pwmConfig(mode, timer_prescale, led_off_value,
+                         phase_offsets[p]);
+      uint32_t frequency_hz =
+          pwm_frequency_hz(&config, PWM_REPORT_CORE_CLOCK_HZ);
+      printf("  %3u/256%s", phase_offsets[p],
+             phase_offsets[p] == pwm_phase_offset ? " (cfg)" : "      ");
+      for (unsigned d = 0; d < sizeof(duties); d++) {
+        uint16_t compare = ticks - ticks * duties[d] / 100;
+        PwmRipple ripple = pwm_ripple(&config, compare, compare);
+        if (ripple.harmonic == 0) {
+          printf(" %12s", "none");
+        } else {
+          printf(" %u @ %6lu", ripple.max_strings - ripple.min_strings,
+                 (unsigned long)(frequency_hz * ripple.harmonic));
+        }
+      }
+      printf("\n");
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+#!/bin/sh
+# Reports static RAM (.data/.bss) usage per source file of a linked firmware
+# and the stack budget left over.
+#
+# usage: ram_report.sh <firmware.elf> [configuration label]
+#
+# The firmware is built with -flto, so the linker map only knows about the
+# LTO partitions. Symbols are attributed to their source file through the
+# debug info instead (nm -l).
+
+set -e
+
+ELF="$1"
+CONFIG="${2:-default}"
+PREFIX="${PREFIX:-riscv64-elf}"
+# CH32V003 SRAM size in bytes
+RAM_SIZE="${RAM_SIZE:-2048}"
+
+if [ -z "$ELF" ]; then
+  echo "usage: $0 <firmware.elf> [configuration label]" >&2
+  exit 1
+fi
+
+echo "RAM budget for $ELF ($CONFIG)"
+echo
+
+printf "%-28s %8s %8s\n" "file" ".data" ".bss"
+
+"$PREFIX-nm" -S -l --size-sort "$ELF" | awk '
+  function hex(digits,    value, digit, i) {
+    value = 0
+    for (i = 1; i <= length(digits); i++) {
+      digit = index("0123456789abcdef", tolower(substr(digits, i, 1))) - 1
+      value = value * 16 + digit
+    }
+    return value
+  }
+
+  # address size type name [file:line]
+  {
+    type = $3
+    if (type ~ /^[DdGg]$/) {
+      section = "data"
+    } else if (type ~ /^[BbSsCc]$/) {
+      section = "bss"
+    } else {
+      next
+    }
+
+    file = "(no debug info)"
+    if (NF >= 5) {
+      file = $5
+      sub(/:[0-9]+$/, "", file)
+      sub(/.*\//, "", file)
+    }
+
+    size = hex($2)
+    bytes[file, section] += size
+    files[file] = 1
+  }
+  END {
+    for (file in files) {
+      printf "%-28s %8d %8d\n", file, bytes[file, "data"], bytes[file, "bss"]
+    }
+  }
+' | sort -k1,1 -s
+
+"$PREFIX-size" -A "$ELF" | awk -v ram_size="$RAM_SIZE" '
+  # Section totals include alignment padding the per-symbol sums miss
+  $1 ~ /^\.s?data$/ { data += $2 }
+  $1 ~ /^\.s?bss$/ { bss += $2 }
+  END {
+    printf "\n%-28s %8d %8d\n", "total (sections)", data, bss
+    printf "%-28s %8d bytes of %d\n", "left for stack", ram_size - data - bss,
+           ram_size
+  }
+'
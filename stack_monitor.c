@@ -0,0 +1,32 @@
+#include "stack_monitor.h"
+
+// Provided by the ch32fun linker script
+extern uint32_t _ebss;
+extern uint32_t _eusrstack;
+
+#define STACK_PAINT_PATTERN 0xA5A5A5A5
+
+void stackMonitor_paint(void) {
+  uint32_t *sp;
+  __asm__ volatile("mv %0, sp" : "=r"(sp));
+
+  // Everything below the current stack pointer is unused at this point. The
+  // volatile keeps the compiler from turning this into a memset call, whose
+  // frame would sit in the very region being painted.
+  for (volatile uint32_t *word = &_ebss; word < sp; word++) {
+    *word = STACK_PAINT_PATTERN;
+  }
+}
+
+uint32_t stackMonitor_size(void) {
+  return (&_eusrstack - &_ebss) * sizeof(uint32_t);
+}
+
+uint32_t stackMonitor_highWater(void) {
+  const volatile uint32_t *word = &_ebss;
+  while (word < &_eusrstack && *word == STACK_PAINT_PATTERN) {
+    word++;
+  }
+
+  return (&_eusrstack - word) * sizeof(uint32_t);
+}
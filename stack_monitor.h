@@ -0,0 +1,18 @@
+#ifndef _LAMP_STACK_MONITOR_H
+#define _LAMP_STACK_MONITOR_H
+
+#include <stdint.h>
+
+// Fills the free RAM between the end of .bss and the current stack pointer
+// with a known pattern. Call first thing in main.
+void stackMonitor_paint(void);
+
+// Bytes between the end of .bss and the top of RAM, i.e. the space the stack
+// can grow into before it collides with static data.
+uint32_t stackMonitor_size(void);
+
+// Deepest stack usage in bytes since stackMonitor_paint, found by scanning for
+// the first overwritten pattern word.
+uint32_t stackMonitor_highWater(void);
+
+#endif
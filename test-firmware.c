@@ -3,11 +3,19 @@
 #include "ch32fun.h"
 #include "ch32v003hw.h"
 #include "config.h"
+#include "pwm.h"
+#include "stack_monitor.h"
 #include "touch_sense.h"
 
 // #include <inttypes.h>
 #include <stdbool.h>
 
+// Deepest stack usage seen so far and the stack space left above it, in bytes.
+// Updated on every main loop iteration, read them with a debugger to check new
+// features against the RAM budget.
+volatile uint32_t stack_high_water = 0;
+volatile uint32_t stack_headroom = 0;
+
 void write_led(bool on) {
   if (on && debug_led_enabled) {
     GPIOC->BSHR = (1 << 3);
@@ -16,7 +24,7 @@ void write_led(bool on) {
   }
 }
 
-void setup_hw() {
+void setup_hw(const PwmConfig *pwm) {
   RCC->APB2PCENR |= RCC_APB2Periph_GPIOC | RCC_APB2Periph_ADC1 |
                     RCC_APB2Periph_GPIOA | RCC_APB2Periph_TIM1 |
                     RCC_APB2Periph_AFIO;
@@ -36,59 +44,38 @@ void setup_hw() {
   GPIOC->CFGLR &= ~(0xf << (4 * 7));
   GPIOC->CFGLR |= (GPIO_Speed_10MHz | GPIO_CNF_OUT_PP_AF) << (4 * 7);
 
-  // Reset timer 1
-  RCC->APB2PRSTR |= RCC_APB2Periph_TIM1;
-  RCC->APB2PRSTR &= ~RCC_APB2Periph_TIM1;
-
-  // Reset timer 2
-  RCC->APB1PRSTR |= RCC_APB1Periph_TIM2;
-  RCC->APB1PRSTR &= ~RCC_APB1Periph_TIM2;
-
-  TIM1->PSC = timer_prescale;
-  TIM2->PSC = timer_prescale;
-
-  TIM1->ATRLR = led_off_value;
-  TIM2->ATRLR = led_off_value;
-
-  TIM1->SWEVGR |= TIM_UG;
-  TIM2->SWEVGR |= TIM_UG;
-
-  // Enable Timer1 Channel2 Output
-  TIM1->CCER |= TIM_CC2E | TIM_CC2P;
-  TIM1->CCER |= TIM_CC2E;
-  TIM1->CHCTLR1 |= TIM_OC2M_2 | TIM_OC2M_1;
-
-  // Enable Timer2 Channel3 Output
-  TIM2->CCER |= TIM_CC3E | TIM_CC3P;
-  // TIM2->CCER |= TIM_CC3E;
-  TIM2->CHCTLR2 |= TIM_OC3M_2 | TIM_OC3M_1;
-
-  TIM1->CH2CVR = led_off_value;
-  TIM2->CH3CVR = led_off_value;
-
-  TIM1->BDTR |= TIM_MOE;
-  TIM2->BDTR |= TIM_MOE;
-
-  TIM1->CTLR1 |= TIM_CEN;
-  TIM2->CTLR1 |= TIM_CEN;
+  pwm_init(pwm);
 }
 
 int main() {
+  stackMonitor_paint();
   SystemInit();
-  setup_hw();
 
-  TouchSensor sensor =
-      touchSensor(GPIOA, 2, 0, touch_oversampling_iterations,
-                  touch_turn_on_calibration_count, touch_hysteresis_window,
-                  touch_recalibrate_settle_iterations);
+  PwmConfig pwm =
+      pwmConfig(pwm_mode, timer_prescale, led_off_value, pwm_phase_offset);
+  setup_hw(&pwm);
 
-  volatile uint32_t *timers[2] = {&TIM2->CH3CVR, &TIM1->CH2CVR};
+#ifdef LAMP_STATIC_CONFIG
+  TouchSensor sensor = touchSensor();
+
+  BrightnessController controller = brightnessController();
+#else
+  TouchSensor sensor = touchSensor(
+      TOUCH_SENSE_IO, touch_sense_portpin, touch_sense_adcno,
+      touch_oversampling_iterations, touch_turn_on_calibration_count,
+      touch_hysteresis_window, touch_recalibrate_settle_iterations);
+
+#define LED_CONTROL_FIELD_ADDRESS(field) &field,
+  volatile uint32_t *timers[] = {LED_CONTROL_FIELDS(LED_CONTROL_FIELD_ADDRESS)};
+#undef LED_CONTROL_FIELD_ADDRESS
 
   BrightnessController controller = brightnessController(
-      timers, 2, brightness_steps, min_brightness_dim_on,
-      min_brightness_min_period_ms, brightness_rampdown_delay_ms,
-      brightness_rampup_delay_ms, turn_off_brightness_rampdown_delay_ms,
-      led_off_value);
+      timers, sizeof(timers) / sizeof(timers[0]), brightness_steps, pwm.mode,
+      min_brightness_dim_on, min_brightness_min_period_ms,
+      brightness_dim_on_fade_ms, brightness_turn_on_fade_ms,
+      brightness_turn_off_fade_ms, brightness_turn_off_tail_fade_ms,
+      brightness_fade_easing, pwm.period);
+#endif
 
   initTouchSensor(&sensor);
 
@@ -147,5 +134,8 @@ int main() {
       brightnessController_set(&controller, brightness);
     }
     write_led(result.pressed);
+
+    stack_high_water = stackMonitor_highWater();
+    stack_headroom = stackMonitor_size() - stack_high_water;
   }
 }
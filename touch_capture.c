@@ -0,0 +1,62 @@
+#include "touch_capture.h"
+
+// Upper bound of polls for a capture before a cycle is given up, so a
+// disconnected pad can't hang the main loop.
+#define TOUCH_CAPTURE_TIMEOUT 1000
+
+void touchCapture_init(void) {
+  RCC->APB2PCENR |= RCC_APB2Periph_GPIOD;
+
+  // The pad is on PD4, TIM2 Channel 1 with the default TIM2 mapping. Start
+  // discharged.
+  GPIOD->CFGLR &= ~(0xf << (4 * 4));
+  GPIOD->CFGLR |= (GPIO_Speed_10MHz | GPIO_CNF_OUT_PP) << (4 * 4);
+  GPIOD->BSHR = 1 << (16 + 4);
+
+  // Timer2 Channel1 input capture on TI1, rising edge, with a short filter
+  // to reject single cycle glitches
+  TIM2->CHCTLR1 |= TIM_CC1S_0 | (TIM_IC1F & (0x2 << 4));
+  TIM2->CCER &= ~TIM_CC1P;
+  TIM2->CCER |= TIM_CC1E;
+}
+
+uint32_t touchCapture_read(uint16_t cycles) {
+  uint32_t ticks = TIM2->ATRLR + 1;
+  uint32_t sum = 0;
+
+  uint32_t cfg_mask = ~(0xf << (4 * 4));
+  uint32_t cfg_output = (GPIO_Speed_10MHz | GPIO_CNF_OUT_PP) << (4 * 4);
+  uint32_t cfg_input = (GPIO_Speed_In | GPIO_CNF_IN_PUPD) << (4 * 4);
+
+  for (int i = 0; i < cycles; i++) {
+    // Discharge the pad
+    GPIOD->BSHR = 1 << (16 + 4);
+    GPIOD->CFGLR = (GPIOD->CFGLR & cfg_mask) | cfg_output;
+    Delay_Us(1);
+
+    // Switch to input, still pulled down since OUTDR is low
+    GPIOD->CFGLR = (GPIOD->CFGLR & cfg_mask) | cfg_input;
+    TIM2->INTFR = ~(TIM_CC1IF | TIM_CC1OF);
+
+    // Release into the pull-up and let the timer timestamp the edge
+    uint32_t start = TIM2->CNT;
+    GPIOD->BSHR = 1 << 4;
+
+    int timeout = TOUCH_CAPTURE_TIMEOUT;
+    while (!(TIM2->INTFR & TIM_CC1IF) && --timeout) {
+    }
+    if (timeout == 0) {
+      continue;
+    }
+
+    // The counter wraps every PWM period, the charge time is much shorter
+    uint32_t end = TIM2->CH1CVR;
+    sum += end >= start ? end - start : end + ticks - start;
+  }
+
+  // Leave the pad discharged between reads
+  GPIOD->BSHR = 1 << (16 + 4);
+  GPIOD->CFGLR = (GPIOD->CFGLR & cfg_mask) | cfg_output;
+
+  return sum;
+}
@@ -0,0 +1,23 @@
+#ifndef _LAMP_TOUCH_CAPTURE_H
+#define _LAMP_TOUCH_CAPTURE_H
+
+#include "ch32fun.h"
+
+#include <stdint.h>
+
+// Touch acquisition through the RC charge time of the pad, as an alternative
+// to the ADC oversampling of ch32v003_touch.h. The pad is discharged, then
+// released into the internal pull-up, and TIM2 channel 1 captures the counter
+// when the pad crosses the input threshold. A larger pad capacitance (finger)
+// means a longer charge time.
+//
+// TIM2 also generates the PWM for LED1, so the capture shares its free running
+// counter and the pad is always on the TIM2 channel 1 pin, PD4. Call
+// touchCapture_init after pwm_init, which resets TIM2.
+
+void touchCapture_init(void);
+
+// Sum of the charge times of `cycles` charge cycles, in timer ticks
+uint32_t touchCapture_read(uint16_t cycles);
+
+#endif
@@ -1,10 +1,50 @@
 #include "touch_sense.h"
 
 #include "ch32fun.h"
+#include "config.h"
+#include "cycle_count.h"
+
+#ifdef LAMP_TOUCH_CAPTURE
+#include "touch_capture.h"
+#else
 #include "ch32v003_touch.h"
+#endif
+
+#ifdef LAMP_STATIC_CONFIG
+#define SENSOR_IO(sensor) TOUCH_SENSE_IO
+#define SENSOR_PORTPIN(sensor) touch_sense_portpin
+#define SENSOR_ADCNO(sensor) touch_sense_adcno
+#define SENSOR_ITERATIONS(sensor) touch_oversampling_iterations
+#define SENSOR_IDLE_VAL_INIT_COUNT(sensor) touch_turn_on_calibration_count
+#define SENSOR_WINDOW_SIZE(sensor) touch_hysteresis_window
+#define SENSOR_SETTLE_ITERATIONS(sensor) touch_recalibrate_settle_iterations
+#else
+#define SENSOR_IO(sensor) ((sensor)->io)
+#define SENSOR_PORTPIN(sensor) ((sensor)->portpin)
+#define SENSOR_ADCNO(sensor) ((sensor)->adcno)
+#define SENSOR_ITERATIONS(sensor) ((sensor)->iterations)
+#define SENSOR_IDLE_VAL_INIT_COUNT(sensor) ((sensor)->idle_val_init_count)
+#define SENSOR_WINDOW_SIZE(sensor) ((sensor)->window_size)
+#define SENSOR_SETTLE_ITERATIONS(sensor) ((sensor)->settle_iterations)
+#endif
 
 bool touchSensorInitialized = false;
 
+#ifdef LAMP_CYCLE_COUNT
+volatile CycleCount read_touch_sensor_cycles = CYCLE_COUNT_INIT;
+#endif
+
+#ifdef LAMP_STATIC_CONFIG
+TouchSensor touchSensor(void) {
+  TouchSensor sensor = {.last_triggered_states = 0,
+                        .current_state_change_systick = SysTick->CNT,
+                        .idle_val = 0,
+                        .current_state = false,
+                        .time_since_trigger = 0};
+
+  return sensor;
+}
+#else
 TouchSensor touchSensor(GPIO_TypeDef *io, int portpin, int adcno,
                         uint16_t iterations, uint16_t idle_val_init_count,
                         uint8_t window_size, uint16_t settle_iterations) {
@@ -23,31 +63,73 @@ TouchSensor touchSensor(GPIO_TypeDef *io, int portpin, int adcno,
 
   return sensor;
 }
+#endif
+
+static uint32_t touchSensor_sample(TouchSensor *sensor) {
+#ifdef LAMP_STATIC_CONFIG
+  (void)sensor;
+#endif
+#ifdef LAMP_TOUCH_CAPTURE
+  // A block takes well under a millisecond, so average blocks for a whole
+  // reading period. The result stays in ticks per SENSOR_ITERATIONS cycles.
+  uint32_t start_systick = SysTick->CNT;
+  uint32_t sum = 0;
+  uint32_t blocks = 0;
+  do {
+    sum += touchCapture_read(SENSOR_ITERATIONS(sensor));
+    blocks++;
+  } while ((SysTick->CNT - start_systick) / DELAY_MS_TIME <
+           touch_capture_reading_ms);
+
+  return sum / blocks;
+#else
+  return ReadTouchPin(SENSOR_IO(sensor), SENSOR_PORTPIN(sensor),
+                      SENSOR_ADCNO(sensor), SENSOR_ITERATIONS(sensor));
+#endif
+}
+
+static void touchSensor_calibrate(TouchSensor *sensor) {
+  sensor->idle_val = 0;
+  for (int i = 0; i < SENSOR_IDLE_VAL_INIT_COUNT(sensor); i++) {
+    sensor->idle_val += touchSensor_sample(sensor);
+  }
+
+  sensor->idle_val /= SENSOR_IDLE_VAL_INIT_COUNT(sensor);
+}
+
+static uint32_t touchSensor_triggerValue(TouchSensor *sensor) {
+#ifdef LAMP_TOUCH_CAPTURE
+  // Every capture cycle is quantized to the same whole tick, so the threshold
+  // has to be a whole number of ticks per cycle, not a fraction of idle_val.
+  return sensor->idle_val +
+         SENSOR_ITERATIONS(sensor) * touch_capture_trigger_ticks;
+#else
+  return sensor->idle_val * 201 / 200;
+#endif
+}
 
 void initTouchSensor(TouchSensor *sensor) {
   if (!touchSensorInitialized) {
     touchSensorInitialized = true;
+#ifdef LAMP_TOUCH_CAPTURE
+    touchCapture_init();
+#else
     InitTouchADC();
+#endif
   }
 
-  sensor->idle_val = 0;
-  for (int i = 0; i < sensor->idle_val_init_count; i++) {
-    sensor->idle_val += ReadTouchPin(sensor->io, sensor->portpin, sensor->adcno,
-                                     sensor->iterations);
-  }
-
-  sensor->idle_val /= sensor->idle_val_init_count;
+  touchSensor_calibrate(sensor);
   sensor->current_state = false;
   sensor->last_triggered_states = 0;
 }
 
 TouchSensorReadResult readTouchSensor(TouchSensor *sensor) {
-  uint32_t oversampled_val = ReadTouchPin(sensor->io, sensor->portpin,
-                                          sensor->adcno, sensor->iterations);
+  CYCLE_COUNT_START();
+  uint32_t oversampled_val = touchSensor_sample(sensor);
 
   sensor->last_triggered_states <<= 1;
 
-  uint32_t trigger_val = ((sensor->idle_val) * 201 / 200);
+  uint32_t trigger_val = touchSensor_triggerValue(sensor);
   bool is_triggered = oversampled_val > trigger_val;
 
   sensor->last_triggered_states |= is_triggered;
@@ -55,9 +137,9 @@ TouchSensorReadResult readTouchSensor(TouchSensor *sensor) {
   bool current_state = sensor->current_state;
   uint32_t current_state_systick = sensor->current_state_change_systick;
 
-  uint32_t mask = (sensor->window_size >= 32)
+  uint32_t mask = (SENSOR_WINDOW_SIZE(sensor) >= 32)
                       ? 0xFFFFFFFF
-                      : ((1U << sensor->window_size) - 1);
+                      : ((1U << SENSOR_WINDOW_SIZE(sensor)) - 1);
 
   uint32_t current_systick = SysTick->CNT;
 
@@ -69,7 +151,7 @@ TouchSensorReadResult readTouchSensor(TouchSensor *sensor) {
     if (timeouted) {
       timeout_triggered = true;
       sensor->last_triggered_states = 0;
-      sensor->time_since_trigger = sensor->settle_iterations;
+      sensor->time_since_trigger = SENSOR_SETTLE_ITERATIONS(sensor);
     }
     if ((sensor->last_triggered_states & mask) == 0x00) {
       current_state = false;
@@ -91,19 +173,14 @@ TouchSensorReadResult readTouchSensor(TouchSensor *sensor) {
       sensor->time_since_trigger++;
     }
 
-    if (sensor->time_since_trigger >= sensor->settle_iterations) {
+    if (sensor->time_since_trigger >= SENSOR_SETTLE_ITERATIONS(sensor)) {
       if (timeout_triggered) {
-        sensor->idle_val = 0;
-        for (int i = 0; i < sensor->idle_val_init_count; i++) {
-          sensor->idle_val += ReadTouchPin(sensor->io, sensor->portpin,
-                                           sensor->adcno, sensor->iterations);
-        }
-        sensor->idle_val /= sensor->idle_val_init_count;
+        touchSensor_calibrate(sensor);
       } else {
         sensor->idle_val =
-            (sensor->idle_val * (sensor->idle_val_init_count - 1) +
+            (sensor->idle_val * (SENSOR_IDLE_VAL_INIT_COUNT(sensor) - 1) +
              oversampled_val) /
-            sensor->idle_val_init_count;
+            SENSOR_IDLE_VAL_INIT_COUNT(sensor);
       }
     }
   }
@@ -125,5 +202,6 @@ TouchSensorReadResult readTouchSensor(TouchSensor *sensor) {
 
   };
 
+  CYCLE_COUNT_STOP(read_touch_sensor_cycles);
   return result;
 }
@@ -6,6 +6,15 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#ifdef LAMP_STATIC_CONFIG
+typedef struct TouchSensor {
+  uint32_t idle_val;
+  uint32_t last_triggered_states;
+  uint32_t current_state_change_systick;
+  bool current_state;
+  uint16_t time_since_trigger;
+} TouchSensor;
+#else
 typedef struct TouchSensor {
   GPIO_TypeDef *io;
   int portpin;
@@ -20,12 +29,17 @@ typedef struct TouchSensor {
   uint16_t time_since_trigger;
   uint16_t settle_iterations;
 } TouchSensor;
+#endif
 
 extern bool touchSensorInitialized;
 
+#ifdef LAMP_STATIC_CONFIG
+TouchSensor touchSensor(void);
+#else
 TouchSensor touchSensor(GPIO_TypeDef *io, int portpin, int adcno,
                         uint16_t iterations, uint16_t idle_val_init_count,
                         uint8_t window_size, uint16_t settle_iterations);
+#endif
 
 void initTouchSensor(TouchSensor *sensor);
 